@@ -1,11 +1,17 @@
 @echo off
 
 set DeleteAll=1
+set Benchmarks=0
 
 set Common=-nologo -Gm- -GR- -EHa- -Zo -Oi -FC -Z7 -WX -W4 -wd4668 -wd4100 -wd4820 -wd4365 -wd4774 -wd4710 -wd5045 -wd4191 -wd4189 -wd4061 -wd4996 -wd4464 -wd4201 -wd5220 -wd5219 -wd4310 -wd4065
 
+set Defines=-DAK_MATH_IMPLEMENTATION -DAK_MATH_TESTS
+IF %Benchmarks% == 1 (
+	set Defines=%Defines% -DAK_MATH_BENCHMARKS -O2
+)
+
 COPY ak_math.h ak_math.cpp
-cl %Common% -DAK_MATH_IMPLEMENTATION -DAK_MATH_TESTS ak_math.cpp -link -opt:ref -incremental:no -out:ak_math.exe
+cl %Common% %Defines% ak_math.cpp -link -opt:ref -incremental:no -out:ak_math.exe
 
 ak_math.exe
 